@@ -0,0 +1,275 @@
+// Own headers
+#include "benchmark.h"
+
+// STL headers
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+
+double elapsedNs(std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point stop)
+{
+  return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+std::string escapeJson(const std::string& text)
+{
+  std::string escaped;
+  for (char c : text)
+  {
+    if (c == '"' || c == '\\')
+    {
+      escaped += '\\';
+    }
+    if (static_cast<unsigned char>(c) >= 0x20)
+    {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// Find "key": within [begin, end) of a JSON document and parse the
+// number following it.
+bool findNumber(const std::string& text, std::size_t begin, std::size_t end,
+                const std::string& key, double& value)
+{
+  std::size_t position = text.find("\"" + key + "\":", begin);
+  if (position == std::string::npos || position >= end)
+  {
+    return false;
+  }
+  value = std::stod(text.substr(position + key.size() + 3, 32));
+  return true;
+}
+
+// Find "key": "..." within [begin, end) of a JSON document and unescape
+// the string following it.
+bool findString(const std::string& text, std::size_t begin, std::size_t end,
+                const std::string& key, std::string& value)
+{
+  const std::string prefix = "\"" + key + "\": \"";
+  std::size_t position = text.find(prefix, begin);
+  if (position == std::string::npos || position >= end)
+  {
+    return false;
+  }
+  value.clear();
+  for (position += prefix.size(); position < text.size() && text[position] != '"'; ++position)
+  {
+    if (text[position] == '\\' && position + 1 < text.size())
+    {
+      ++position;
+    }
+    value += text[position];
+  }
+  return position < text.size();
+}
+
+} // namespace
+
+BenchmarkRunner::BenchmarkRunner(std::size_t warmupIterations, std::size_t iterations,
+                                 const std::string& filter)
+  : m_WarmupIterations(warmupIterations)
+  , m_Iterations(std::max<std::size_t>(iterations, 1))
+  , m_Filter(filter)
+{
+}
+
+void BenchmarkRunner::run(const std::string& name, std::size_t datasetSize,
+                          const std::function<void()>& body,
+                          const std::function<void()>& setup)
+{
+  if (!enabled(name))
+  {
+    return;
+  }
+
+  std::vector<double> samples;
+  double warmupTotalNs = 0.0;
+  for (std::size_t i = 0; i < m_WarmupIterations + m_Iterations; ++i)
+  {
+    if (setup)
+    {
+      setup();
+    }
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto stop = std::chrono::steady_clock::now();
+
+    if (i < m_WarmupIterations)
+    {
+      warmupTotalNs += elapsedNs(start, stop);
+    }
+    else
+    {
+      samples.push_back(elapsedNs(start, stop));
+    }
+  }
+
+  std::sort(samples.begin(), samples.end());
+  BenchmarkResult result;
+  result.name = name;
+  result.datasetSize = datasetSize;
+  result.warmupIterations = m_WarmupIterations;
+  result.iterations = m_Iterations;
+  result.warmupMeanNs = m_WarmupIterations > 0 ? warmupTotalNs / m_WarmupIterations : 0.0;
+  result.minNs = samples.front();
+  result.meanNs = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+  std::size_t middle = samples.size() / 2;
+  result.medianNs = (samples.size() % 2 != 0) ? samples[middle]
+                                              : 0.5 * (samples[middle - 1] + samples[middle]);
+  // Nearest rank percentile.
+  std::size_t p99Rank = (std::size_t)std::ceil(0.99 * samples.size());
+  result.p99Ns = samples[std::max<std::size_t>(p99Rank, 1) - 1];
+  m_Results.push_back(result);
+
+  fprintf(stderr, "%-32s %10zu  median %12.0f ns  p99 %12.0f ns  warm-up %12.0f ns\n",
+          name.c_str(), datasetSize, result.medianNs, result.p99Ns, result.warmupMeanNs);
+}
+
+bool BenchmarkRunner::enabled(const std::string& name) const
+{
+  return name.find(m_Filter) != std::string::npos;
+}
+
+void writeJson(std::ostream& stream, const BenchmarkConfig& config,
+               const std::vector<BenchmarkResult>& results)
+{
+  stream << "{\n";
+  stream << "  \"seed\": " << config.seed << ",\n";
+  stream << "  \"dataset\": \"" << escapeJson(config.datasetName) << "\",\n";
+  stream << "  \"warmup_iterations\": " << config.warmupIterations << ",\n";
+  stream << "  \"iterations\": " << config.iterations << ",\n";
+  stream << "  \"renderer\": \"" << escapeJson(config.renderer) << "\",\n";
+  stream << "  \"benchmarks\": [\n";
+  // One benchmark per line, which keeps baselines easy to diff.
+  char line[512];
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchmarkResult& result = results[i];
+    snprintf(line, sizeof(line),
+             "    {\"name\": \"%s\", \"dataset_size\": %zu, \"warmup_mean_ns\": %.0f, "
+             "\"min_ns\": %.0f, \"mean_ns\": %.0f, \"median_ns\": %.0f, \"p99_ns\": %.0f}%s\n",
+             escapeJson(result.name).c_str(), result.datasetSize, result.warmupMeanNs,
+             result.minNs, result.meanNs, result.medianNs, result.p99Ns,
+             (i + 1 < results.size()) ? "," : "");
+    stream << line;
+  }
+  stream << "  ]\n";
+  stream << "}\n";
+}
+
+bool readBaseline(const std::string& path, BenchmarkConfig& config,
+                  std::vector<BenchmarkResult>& results)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    std::cerr << "Failed to open the baseline '" << path << "'." << std::endl;
+    return false;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string text = contents.str();
+
+  try {
+    // The settings precede the benchmark list.
+    std::size_t listBegin = text.find("\"benchmarks\":");
+    double seed = 0.0;
+    if (listBegin == std::string::npos
+        || !findNumber(text, 0, listBegin, "seed", seed)
+        || !findString(text, 0, listBegin, "dataset", config.datasetName)
+        || !findString(text, 0, listBegin, "renderer", config.renderer))
+    {
+      std::cerr << "The baseline '" << path << "' is missing its settings." << std::endl;
+      return false;
+    }
+    config.seed = (unsigned int)seed;
+
+    results.clear();
+    const std::string nameKey = "\"name\": \"";
+    std::size_t position = text.find(nameKey, listBegin);
+    while (position != std::string::npos)
+    {
+      std::size_t next = text.find(nameKey, position + nameKey.size());
+      std::size_t end = (next == std::string::npos) ? text.size() : next;
+
+      BenchmarkResult result;
+      double datasetSize = 0.0;
+      if (!findString(text, position, end, "name", result.name)
+          || !findNumber(text, position, end, "dataset_size", datasetSize)
+          || !findNumber(text, position, end, "median_ns", result.medianNs))
+      {
+        std::cerr << "The baseline '" << path << "' has a malformed benchmark entry." << std::endl;
+        return false;
+      }
+      result.datasetSize = (std::size_t)datasetSize;
+      findNumber(text, position, end, "p99_ns", result.p99Ns);
+      results.push_back(result);
+      position = next;
+    }
+  } catch (const std::exception&)
+  {
+    std::cerr << "The baseline '" << path << "' is malformed." << std::endl;
+    return false;
+  }
+
+  if (results.empty())
+  {
+    std::cerr << "The baseline '" << path << "' contains no benchmarks." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool compatibleWithBaseline(const BenchmarkConfig& config, const BenchmarkConfig& baseline)
+{
+  if (config.seed != baseline.seed || config.datasetName != baseline.datasetName)
+  {
+    fprintf(stderr, "The baseline was recorded with seed %u and data set '%s', "
+                    "this run uses seed %u and data set '%s'.\n",
+            baseline.seed, baseline.datasetName.c_str(),
+            config.seed, config.datasetName.c_str());
+    return false;
+  }
+  return true;
+}
+
+int compareWithBaseline(const std::vector<BenchmarkResult>& results,
+                        const std::vector<BenchmarkResult>& baseline,
+                        double threshold, std::size_t& matched)
+{
+  int regressions = 0;
+  matched = 0;
+  for (const auto& result : results)
+  {
+    auto reference = std::find_if(baseline.begin(), baseline.end(),
+                                  [&result](const BenchmarkResult& candidate)
+                                  {
+                                    return candidate.name == result.name
+                                        && candidate.datasetSize == result.datasetSize;
+                                  });
+    if (reference == baseline.end() || reference->medianNs <= 0.0)
+    {
+      fprintf(stderr, "%-32s %10zu  no baseline\n", result.name.c_str(), result.datasetSize);
+      continue;
+    }
+
+    ++matched;
+    double change = result.medianNs / reference->medianNs - 1.0;
+    bool regressed = change > threshold;
+    regressions += regressed ? 1 : 0;
+    fprintf(stderr, "%-32s %10zu  median %+7.1f%%%s\n", result.name.c_str(),
+            result.datasetSize, 100.0 * change, regressed ? "  REGRESSION" : "");
+  }
+  return regressions;
+}
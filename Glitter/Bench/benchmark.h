@@ -0,0 +1,83 @@
+#ifndef GLITTER_BENCHMARK_H
+#define GLITTER_BENCHMARK_H
+
+// STL headers
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult
+{
+  std::string name;
+  // Size of the data set the benchmark ran on, e.g. vertices or bytes.
+  std::size_t datasetSize = 0;
+  std::size_t warmupIterations = 0;
+  std::size_t iterations = 0;
+  // Timings in nanoseconds.
+  double warmupMeanNs = 0.0;
+  double minNs = 0.0;
+  double meanNs = 0.0;
+  double medianNs = 0.0;
+  double p99Ns = 0.0;
+};
+
+// Settings the results were produced with, written next to them so
+// that runs can be compared.
+struct BenchmarkConfig
+{
+  unsigned int seed = 1;
+  std::string datasetName;
+  std::size_t warmupIterations = 0;
+  std::size_t iterations = 0;
+  std::string renderer;
+};
+
+class BenchmarkRunner
+{
+public:
+  BenchmarkRunner(std::size_t warmupIterations, std::size_t iterations,
+                  const std::string& filter);
+
+  // Time body for the configured number of warm-up and measured
+  // iterations. setup runs untimed before every iteration. Benchmarks
+  // whose name does not contain the filter are skipped.
+  void run(const std::string& name, std::size_t datasetSize,
+           const std::function<void()>& body,
+           const std::function<void()>& setup = nullptr);
+
+  // Whether run() would time the named benchmark, so that callers can
+  // skip the setup of filtered out ones.
+  bool enabled(const std::string& name) const;
+
+  const std::vector<BenchmarkResult>& results() const { return m_Results; }
+
+private:
+  std::size_t m_WarmupIterations;
+  std::size_t m_Iterations;
+  std::string m_Filter;
+  std::vector<BenchmarkResult> m_Results;
+};
+
+void writeJson(std::ostream& stream, const BenchmarkConfig& config,
+               const std::vector<BenchmarkResult>& results);
+
+// Read the settings and results of a previous run, as written by
+// writeJson(). Returns false if the file cannot be read, is malformed or
+// contains no results.
+bool readBaseline(const std::string& path, BenchmarkConfig& config,
+                  std::vector<BenchmarkResult>& results);
+
+// Whether two runs are comparable: the seed and data set have to match.
+bool compatibleWithBaseline(const BenchmarkConfig& config, const BenchmarkConfig& baseline);
+
+// Compare the medians of benchmarks present in both runs. A benchmark
+// regressed when its median grew by more than threshold (0.1 = 10%).
+// Returns the number of regressions; matched receives the number of
+// benchmarks found in the baseline.
+int compareWithBaseline(const std::vector<BenchmarkResult>& results,
+                        const std::vector<BenchmarkResult>& baseline,
+                        double threshold, std::size_t& matched);
+
+#endif // GLITTER_BENCHMARK_H
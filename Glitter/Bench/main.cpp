@@ -0,0 +1,653 @@
+// Own Headers
+#include "benchmark.h"
+#include "culling.h"
+#include "residency.h"
+#include "shader.h"
+
+// 3rd party headers
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// STL Headers
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Fixed data set sizes, so that runs with the same size are comparable.
+struct Dataset
+{
+  const char* name;
+  // Quads per side of the imported grid mesh.
+  int meshGrid;
+  // Width and height of decoded and uploaded images.
+  int imageSize;
+  std::size_t bufferBytes;
+  int sceneObjects;
+};
+
+const Dataset datasets[] = {
+    {"small",   64,  256,  1 << 20,  1024},
+    {"medium", 256, 1024, 16 << 20, 16384},
+    {"large",  512, 2048, 64 << 20, 65536},
+};
+
+// Resolution of the offscreen frame buffer used by the frame benchmarks.
+const int frameWidth = 512;
+const int frameHeight = 512;
+
+void printUsage()
+{
+  std::cerr << "Usage: glitter_bench [options]" << std::endl
+            << "  --size small|medium|large  Data set size (default: small)" << std::endl
+            << "  --seed N                   Seed of the synthetic data (default: 1)" << std::endl
+            << "  --warmup N                 Warm-up iterations (default: 5)" << std::endl
+            << "  --iterations N             Measured iterations (default: 50)" << std::endl
+            << "  --filter TEXT              Only run benchmarks containing TEXT" << std::endl
+            << "  --output PATH              Write JSON results to PATH (default: stdout)" << std::endl
+            << "  --baseline PATH            Compare against the JSON results in PATH" << std::endl
+            << "  --threshold X              Allowed median regression (default: 0.10)" << std::endl
+            << "  --headless                 Use the null platform and a surfaceless EGL context" << std::endl
+            << "  --osmesa                   Use the null platform and OSMesa" << std::endl;
+}
+
+// Wavefront OBJ grid of quads with a jittered height field.
+std::string generateObj(int grid, std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+  std::ostringstream obj;
+  for (int y = 0; y <= grid; ++y)
+  for (int x = 0; x <= grid; ++x)
+  {
+    obj << "v " << x << " " << jitter(rng) << " " << y << "\n";
+    obj << "vt " << (float)x / grid << " " << (float)y / grid << "\n";
+  }
+  obj << "vn 0 1 0\n";
+  for (int y = 0; y < grid; ++y)
+  for (int x = 0; x < grid; ++x)
+  {
+    // OBJ indices are one based.
+    int corner = y * (grid + 1) + x + 1;
+    int corners[] = {corner, corner + grid + 1, corner + grid + 2, corner + 1};
+    obj << "f";
+    for (int index : corners)
+    {
+      obj << " " << index << "/" << index << "/1";
+    }
+    obj << "\n";
+  }
+  return obj.str();
+}
+
+// Smooth gradient with noise, so that the image compresses like a photo
+// rather than like a flat color.
+std::vector<unsigned char> generateImage(int size, int channels, std::mt19937& rng)
+{
+  std::uniform_int_distribution<int> noise(-16, 16);
+  std::vector<unsigned char> image((std::size_t)size * size * channels);
+  for (int y = 0; y < size; ++y)
+  for (int x = 0; x < size; ++x)
+  for (int c = 0; c < channels; ++c)
+  {
+    int value = (x * (c + 1) + y * (channels - c)) * 255 / (size * (channels + 1)) + noise(rng);
+    image[((std::size_t)y * size + x) * channels + c] = (unsigned char)std::min(255, std::max(0, value));
+  }
+  return image;
+}
+
+void appendToVector(void* context, void* data, int size)
+{
+  auto bytes = static_cast<unsigned char*>(data);
+  static_cast<std::vector<unsigned char>*>(context)->insert(
+      static_cast<std::vector<unsigned char>*>(context)->end(), bytes, bytes + size);
+}
+
+// Same post-processing and scene walk as Mirage::Mesh.
+std::size_t importMesh(const std::string& obj)
+{
+  Assimp::Importer loader;
+  const aiScene* scene = loader.ReadFileFromMemory(
+      obj.data(), obj.size(),
+      aiProcessPreset_TargetRealtime_MaxQuality |
+      aiProcess_OptimizeGraph                   |
+      aiProcess_FlipUVs, "obj");
+  if (!scene)
+  {
+    fprintf(stderr, "%s\n", loader.GetErrorString());
+    return 0;
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<GLuint> indices;
+  std::vector<const aiNode*> nodes{scene->mRootNode};
+  while (!nodes.empty())
+  {
+    const aiNode* node = nodes.back();
+    nodes.pop_back();
+    for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+    {
+      const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+      for (unsigned int v = 0; v < mesh->mNumVertices; ++v)
+      {
+        positions.emplace_back(mesh->mVertices[v].x, mesh->mVertices[v].y, mesh->mVertices[v].z);
+      }
+      for (unsigned int f = 0; f < mesh->mNumFaces; ++f)
+      for (unsigned int j = 0; j < mesh->mFaces[f].mNumIndices; ++j)
+      {
+        indices.push_back(mesh->mFaces[f].mIndices[j]);
+      }
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; ++i)
+    {
+      nodes.push_back(node->mChildren[i]);
+    }
+  }
+  return positions.size();
+}
+
+void benchmarkImport(BenchmarkRunner& runner, const Dataset& dataset, unsigned int seed)
+{
+  if (!runner.enabled("mesh_import/obj"))
+  {
+    return;
+  }
+  std::mt19937 rng(seed);
+  std::string obj = generateObj(dataset.meshGrid, rng);
+  std::size_t vertices = (std::size_t)(dataset.meshGrid + 1) * (dataset.meshGrid + 1);
+  runner.run("mesh_import/obj", vertices, [&obj]() { importMesh(obj); });
+}
+
+void benchmarkDecode(BenchmarkRunner& runner, const Dataset& dataset, unsigned int seed)
+{
+  if (!runner.enabled("decode/png") && !runner.enabled("decode/jpg"))
+  {
+    return;
+  }
+  std::mt19937 rng(seed);
+  int size = dataset.imageSize;
+  std::vector<unsigned char> rgba = generateImage(size, 4, rng);
+  std::vector<unsigned char> rgb = generateImage(size, 3, rng);
+
+  std::vector<unsigned char> png, jpg;
+  stbi_write_png_to_func(appendToVector, &png, size, size, 4, rgba.data(), size * 4);
+  stbi_write_jpg_to_func(appendToVector, &jpg, size, size, 3, rgb.data(), 90);
+
+  std::size_t pixels = (std::size_t)size * size;
+  for (auto encoded : {std::make_pair("decode/png", &png), std::make_pair("decode/jpg", &jpg)})
+  {
+    const std::vector<unsigned char>& data = *encoded.second;
+    runner.run(encoded.first, pixels, [&data]()
+    {
+      int width, height, channels;
+      unsigned char* image = stbi_load_from_memory(data.data(), (int)data.size(),
+                                                   &width, &height, &channels, 0);
+      stbi_image_free(image);
+    });
+  }
+}
+
+void benchmarkUpload(BenchmarkRunner& runner, const Dataset& dataset, unsigned int seed)
+{
+  if (!runner.enabled("upload/texture") && !runner.enabled("upload/buffer")
+      && !runner.enabled("upload/residency_stream"))
+  {
+    return;
+  }
+  std::mt19937 rng(seed);
+  int size = dataset.imageSize;
+  std::vector<unsigned char> image = generateImage(size, 4, rng);
+
+  // Same path as the textures in main.cpp.
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  runner.run("upload/texture", image.size(), [&]()
+  {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish();
+  });
+  glDeleteTextures(1, &texture);
+
+  // The buffer data is drawn from the generator after the image, so
+  // skipping either part below leaves the other one's data unchanged.
+  if (runner.enabled("upload/buffer"))
+  {
+    std::vector<unsigned char> data(dataset.bufferBytes);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& value : data)
+    {
+      value = (unsigned char)byte(rng);
+    }
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    runner.run("upload/buffer", data.size(), [&data]()
+    {
+      glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+      glFinish();
+    });
+    glDeleteBuffers(1, &buffer);
+  }
+
+  if (runner.enabled("upload/residency_stream"))
+  {
+    // Eight textures against a budget fitting half of them, touching
+    // alternating halves forces a full evict and restore every frame.
+    GLint levels = 1;
+    while ((size >> levels) > 0)
+    {
+      ++levels;
+    }
+    std::size_t totalBytes = 8 * ResidencyManager::textureSize(GL_RGBA8, size, size, levels);
+    std::vector<GLuint> textures;
+    ResidencyManager residency(totalBytes / 2);
+    for (int i = 0; i < 8; ++i)
+    {
+      textures.push_back(residency.createTexture2D(GL_RGBA8, size, size, GL_RGBA,
+                                                   GL_UNSIGNED_BYTE, image.data()));
+    }
+    std::size_t frame = 0;
+    runner.run("upload/residency_stream", totalBytes, [&]()
+    {
+      residency.beginFrame();
+      for (std::size_t i = frame % 2; i < textures.size(); i += 2)
+      {
+        residency.touchTexture(textures[i]);
+      }
+      residency.update();
+      glFinish();
+      ++frame;
+    });
+  }
+}
+
+std::string readFile(const char* path)
+{
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+void benchmarkShader(BenchmarkRunner& runner)
+{
+  if (!runner.enabled("shader/compile_link") && !runner.enabled("shader/set_uniforms"))
+  {
+    return;
+  }
+  // Only compilation and linking are timed, not reading the sources.
+  const std::string vertexSource = readFile("scene.vert");
+  const std::string fragmentSource = readFile("rectangle.frag");
+  runner.run("shader/compile_link", 1, [&]()
+  {
+    Shader shader = Shader::fromSource(vertexSource, fragmentSource);
+    glDeleteProgram(shader.id());
+  });
+
+  const int uniformCalls = 1000;
+  Shader shader("scene.vert", "rectangle.frag");
+  shader.use();
+  glm::mat4 viewProjection(1.0f);
+  runner.run("shader/set_uniforms", uniformCalls, [&]()
+  {
+    for (int i = 0; i < uniformCalls; ++i)
+    {
+      shader.setMat4f("viewProjection", viewProjection);
+      shader.setInt("containerTexture", 0);
+      shader.setInt("faceTexture", 1);
+    }
+    glFinish();
+  });
+  glDeleteProgram(shader.id());
+}
+
+// Returns false when the GPU culling path disagrees with the CPU one.
+bool benchmarkFrame(BenchmarkRunner& runner, const Dataset& dataset, unsigned int seed)
+{
+  if (!runner.enabled("frame/cpu_cull") && !runner.enabled("frame/gpu_cull")
+      && !runner.enabled("frame/gpu_cull_hiz"))
+  {
+    return true;
+  }
+  std::mt19937 rng(seed);
+
+  // Textured rectangle, as drawn by main.cpp.
+  float vertices[] = {
+       0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,
+       0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,
+      -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,
+      -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f
+  };
+  unsigned int indices[] = {0, 1, 3, 1, 2, 3};
+  GLuint VAO, VBO, EBO;
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &VBO);
+  glGenBuffers(1, &EBO);
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+  glEnableVertexAttribArray(2);
+
+  // Rectangles scattered in a box around the camera's view direction,
+  // a part of them ends up outside the frustum or behind others.
+  std::uniform_real_distribution<float> spread(-40.0f, 40.0f);
+  std::uniform_real_distribution<float> depth(-80.0f, 0.0f);
+  std::vector<ObjectData> objects;
+  for (int i = 0; i < dataset.sceneObjects; ++i)
+  {
+    glm::vec3 position(spread(rng), spread(rng), depth(rng));
+    ObjectData object{};
+    object.model = glm::translate(glm::mat4(1.0f), position);
+    object.bounds = glm::vec4(position, 0.7072f);
+    object.indexCount = 6;
+    objects.push_back(object);
+  }
+  Culler culler(objects);
+  culler.attach(VAO, 3);
+
+  std::vector<unsigned char> image = generateImage(256, 4, rng);
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 256, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glActiveTexture(GL_TEXTURE0);
+
+  // Offscreen target, the depth texture feeds the depth pyramid directly.
+  GLuint framebuffer, colorBuffer, depthTexture;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, frameWidth, frameHeight);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  glGenTextures(1, &depthTexture);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, frameWidth, frameHeight, 0,
+               GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glViewport(0, 0, frameWidth, frameHeight);
+  glEnable(GL_DEPTH_TEST);
+
+  Shader shader("scene.vert", "rectangle.frag");
+  shader.use();
+  shader.setInt("containerTexture", 0);
+  shader.setInt("faceTexture", 1);
+  glm::mat4 viewProjection =
+      glm::perspective(glm::radians(45.0f), (float)frameWidth / (float)frameHeight, 0.1f, 100.0f) *
+      glm::lookAt(glm::vec3(0.0f, 0.0f, 20.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+  bool occlusionCulling = false;
+  auto frame = [&]()
+  {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    culler.cull(viewProjection);
+    shader.use();
+    shader.setMat4f("viewProjection", viewProjection);
+    culler.draw(VAO);
+    if (occlusionCulling)
+    {
+      culler.buildDepthPyramid(depthTexture, frameWidth, frameHeight);
+    }
+    glFinish();
+  };
+
+  culler.setMode(Culler::Mode::Cpu);
+  runner.run("frame/cpu_cull", objects.size(), frame);
+  bool consistent = true;
+  if (culler.gpuSupported())
+  {
+    // Frustum culling on the GPU has to select the same objects as the
+    // CPU fallback on the seeded scene.
+    culler.cull(viewProjection);
+    GLuint cpuVisible = culler.visibleCount();
+    culler.setMode(Culler::Mode::Gpu);
+    culler.cull(viewProjection);
+    GLuint gpuVisible = culler.visibleCount();
+    if (gpuVisible != cpuVisible)
+    {
+      fprintf(stderr, "GPU culling kept %u of %zu objects, CPU culling %u\n",
+              gpuVisible, objects.size(), cpuVisible);
+      consistent = false;
+    }
+
+    runner.run("frame/gpu_cull", objects.size(), frame);
+    occlusionCulling = true;
+    culler.setOcclusionCulling(true);
+    runner.run("frame/gpu_cull_hiz", objects.size(), frame);
+  }
+
+  glDisable(GL_DEPTH_TEST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(1, &colorBuffer);
+  glDeleteTextures(1, &depthTexture);
+  glDeleteTextures(1, &texture);
+  glDeleteProgram(shader.id());
+  glDeleteVertexArrays(1, &VAO);
+  glDeleteBuffers(1, &VBO);
+  glDeleteBuffers(1, &EBO);
+  return consistent;
+}
+
+} // namespace
+
+int main(int argc, char * argv[]) {
+
+  // Parse the command line.
+  const Dataset* dataset = &datasets[0];
+  BenchmarkConfig config;
+  config.warmupIterations = 5;
+  config.iterations = 50;
+  std::string filter, outputPath, baselinePath;
+  double threshold = 0.10;
+  bool headless = false;
+  int contextApi = GLFW_NATIVE_CONTEXT_API;
+  try {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string argument = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (argument == "--headless")
+      {
+        headless = true;
+        contextApi = GLFW_EGL_CONTEXT_API;
+      }
+      else if (argument == "--osmesa")
+      {
+        headless = true;
+        contextApi = GLFW_OSMESA_CONTEXT_API;
+      }
+      else if (argument == "--size" && hasValue)
+      {
+        std::string name = argv[++i];
+        dataset = nullptr;
+        for (const auto& candidate : datasets)
+          if (name == candidate.name)
+            dataset = &candidate;
+        if (dataset == nullptr)
+        {
+          printUsage();
+          return EXIT_FAILURE;
+        }
+      }
+      else if (argument == "--seed" && hasValue)
+        config.seed = (unsigned int)std::stoul(argv[++i]);
+      else if (argument == "--warmup" && hasValue)
+        config.warmupIterations = std::stoul(argv[++i]);
+      else if (argument == "--iterations" && hasValue)
+        config.iterations = std::stoul(argv[++i]);
+      else if (argument == "--filter" && hasValue)
+        filter = argv[++i];
+      else if (argument == "--output" && hasValue)
+        outputPath = argv[++i];
+      else if (argument == "--baseline" && hasValue)
+        baselinePath = argv[++i];
+      else if (argument == "--threshold" && hasValue)
+        threshold = std::stod(argv[++i]);
+      else
+      {
+        printUsage();
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (const std::logic_error&)
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  config.datasetName = dataset->name;
+
+  // Read the baseline up front, so that a bad one fails before the run.
+  BenchmarkConfig baselineConfig;
+  std::vector<BenchmarkResult> baseline;
+  if (!baselinePath.empty()
+      && (!readBaseline(baselinePath, baselineConfig, baseline)
+          || !compatibleWithBaseline(config, baselineConfig)))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Likewise open the output before the run.
+  std::ofstream output;
+  if (!outputPath.empty())
+  {
+    output.open(outputPath);
+    if (!output)
+    {
+      fprintf(stderr, "Failed to open '%s' for writing\n", outputPath.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Create a hidden window. Headless runs use GLFW's null platform, which
+  // needs no display, with a surfaceless EGL context or, with --osmesa, a
+  // software OSMesa context (no longer shipped by Mesa 25.1 and later).
+  if (headless)
+  {
+#ifdef GLFW_PLATFORM_NULL
+    if (!glfwPlatformSupported(GLFW_PLATFORM_NULL))
+    {
+      fprintf(stderr, "Headless mode needs GLFW built with the null platform\n");
+      return EXIT_FAILURE;
+    }
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+    fprintf(stderr, "Headless mode needs GLFW 3.4 or newer\n");
+    return EXIT_FAILURE;
+#endif
+  }
+  if (!glfwInit())
+  {
+    fprintf(stderr, "Failed to initialize GLFW\n");
+    return EXIT_FAILURE;
+  }
+  // GPU culling needs GL 4.3, fall back to 3.3 like the demo does.
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextApi);
+  auto mWindow = glfwCreateWindow(frameWidth, frameHeight, "glitter_bench", nullptr, nullptr);
+  if (mWindow == nullptr) {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    mWindow = glfwCreateWindow(frameWidth, frameHeight, "glitter_bench", nullptr, nullptr);
+  }
+  if (mWindow == nullptr) {
+    if (headless)
+      fprintf(stderr, "Failed to Create a headless OpenGL Context with %s\n",
+              contextApi == GLFW_EGL_CONTEXT_API ? "EGL" : "OSMesa");
+    else
+      fprintf(stderr, "Failed to Create OpenGL Context\n");
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  glfwMakeContextCurrent(mWindow);
+  gladLoadGL();
+  config.renderer = std::string(reinterpret_cast<const char*>(glGetString(GL_RENDERER)))
+                  + " / OpenGL " + reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  fprintf(stderr, "%s, data set '%s', seed %u\n",
+          config.renderer.c_str(), dataset->name, config.seed);
+  if (!baselinePath.empty() && config.renderer != baselineConfig.renderer)
+  {
+    fprintf(stderr, "Warning: the baseline was recorded on '%s'\n",
+            baselineConfig.renderer.c_str());
+  }
+
+  BenchmarkRunner runner(config.warmupIterations, config.iterations, filter);
+  benchmarkImport(runner, *dataset, config.seed);
+  benchmarkDecode(runner, *dataset, config.seed);
+  benchmarkUpload(runner, *dataset, config.seed);
+  benchmarkShader(runner);
+  bool cullingConsistent = benchmarkFrame(runner, *dataset, config.seed);
+  glfwTerminate();
+
+  // Report the results.
+  if (outputPath.empty())
+  {
+    writeJson(std::cout, config, runner.results());
+  }
+  else
+  {
+    writeJson(output, config, runner.results());
+    output.close();
+    if (!output)
+    {
+      fprintf(stderr, "Failed to write the results to '%s'\n", outputPath.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!cullingConsistent)
+  {
+    return EXIT_FAILURE;
+  }
+  if (!baselinePath.empty())
+  {
+    std::size_t matched = 0;
+    int regressions = compareWithBaseline(runner.results(), baseline, threshold, matched);
+    if (matched == 0)
+    {
+      fprintf(stderr, "No benchmark matched the baseline\n");
+      return EXIT_FAILURE;
+    }
+    if (regressions > 0)
+    {
+      fprintf(stderr, "%d benchmark(s) regressed by more than %.0f%%\n", regressions, 100.0 * threshold);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
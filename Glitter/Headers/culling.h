@@ -0,0 +1,129 @@
+#ifndef GLITTER_CULLING_H
+#define GLITTER_CULLING_H
+
+// Own headers
+#include "residency.h"
+#include "shader.h"
+
+// 3rd party headers
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// STL headers
+#include <array>
+#include <memory>
+#include <vector>
+
+// Layout of the indirect draw records, as defined by the GL specification.
+struct DrawElementsIndirectCommand
+{
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// Per object data, shared by the culling compute shader (std430 layout)
+// and the vertex shader, which reads the model matrix as an instanced
+// vertex attribute.
+struct ObjectData
+{
+  glm::mat4 model;
+  // World space bounding sphere: center in xyz, radius in w.
+  glm::vec4 bounds;
+  // Range of the shared index buffer which draws the object.
+  GLuint indexCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint padding;
+};
+
+// Frustum (and optionally Hi-Z occlusion) culling of a set of objects,
+// which share one vertex array object, followed by the submission of
+// the visible ones.
+//
+// The GPU path culls in a compute shader, which writes indirect draw
+// commands consumed by glMultiDrawElementsIndirectCount. Without the
+// count variant, the commands are not compacted and culled objects are
+// drawn with zero instances. The CPU path culls on the CPU and issues
+// one glDrawElementsBaseVertex per visible object, with the model matrix
+// passed as a constant attribute value, so it needs neither compute
+// shaders nor base instance support. It is used on GL < 4.3 contexts.
+//
+// GPU allocations are accounted with the residency manager, if given.
+//
+// Usage per frame: cull(), draw(), and when occlusion culling is enabled,
+// buildDepthPyramid() with the depth of the rendered frame.
+class Culler
+{
+public:
+  enum class Mode { Cpu, Gpu };
+
+  explicit Culler(const std::vector<ObjectData>& objects,
+                  ResidencyManager* residency = nullptr);
+  ~Culler();
+
+  // Add the per object model matrix to a vertex array object, as an
+  // instanced mat4 attribute starting at the given location.
+  void attach(GLuint vertexArray, GLuint modelLocation);
+
+  bool gpuSupported() const { return m_GpuSupported; }
+  void setMode(Mode mode);
+  Mode mode() const { return m_Mode; }
+  // Occlusion culling against the previous frame's depth pyramid,
+  // only available on the GPU path.
+  void setOcclusionCulling(bool enabled) { m_OcclusionCulling = enabled; }
+  // Whether the next cull() tests against a depth pyramid, i.e. whether
+  // the caller has to provide one through buildDepthPyramid().
+  bool needsDepthPyramid() const { return m_Mode == Mode::Gpu && m_OcclusionCulling; }
+
+  void cull(const glm::mat4& viewProjection);
+  void draw(GLuint vertexArray) const;
+  // Build the max depth pyramid used for occlusion culling in the next
+  // frame from a depth texture of the frame which was culled last. Does
+  // nothing unless needsDepthPyramid().
+  void buildDepthPyramid(GLuint depthTexture, GLsizei width, GLsizei height);
+
+  // Number of objects which passed culling. Reading it back from the
+  // GPU path stalls the pipeline.
+  GLuint visibleCount() const;
+
+private:
+  using FrustumPlanes = std::array<glm::vec4, 6>;
+
+  static FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProjection);
+  static bool sphereInFrustum(const FrustumPlanes& planes, const glm::vec4& sphere);
+
+  void cullCpu(const FrustumPlanes& planes);
+  void cullGpu(const FrustumPlanes& planes);
+
+  std::vector<ObjectData> m_Objects;
+  Mode m_Mode = Mode::Cpu;
+  bool m_GpuSupported = false;
+  bool m_OcclusionCulling = false;
+  // glMultiDrawElementsIndirectCount (GL 4.6 or ARB_indirect_parameters).
+  bool m_IndirectCount = false;
+  GLuint m_ModelLocation = 0;
+  ResidencyManager* m_Residency;
+  std::size_t m_AccountedBytes = 0;
+
+  // CPU path state.
+  std::vector<GLuint> m_VisibleObjects;
+
+  // GPU path state.
+  std::unique_ptr<Shader> m_CullShader;
+  std::unique_ptr<Shader> m_DepthPyramidShader;
+  GLuint m_ObjectBuffer = 0;
+  GLuint m_CommandBuffer = 0;
+  GLuint m_DrawCountBuffer = 0;
+  GLuint m_DepthPyramid = 0;
+  GLsizei m_DepthPyramidWidth = 0;
+  GLsizei m_DepthPyramidHeight = 0;
+  GLint m_DepthPyramidLevels = 0;
+  glm::mat4 m_ViewProjection{1.0f};
+  glm::mat4 m_DepthPyramidViewProjection{1.0f};
+};
+
+#endif // GLITTER_CULLING_H
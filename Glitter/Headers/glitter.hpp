@@ -15,5 +15,11 @@
 // Define Some Constants
 const int mWidth = 800;
 const int mHeight = 600;
+// Default VRAM budget of the residency manager, in MiB.
+const int mVramBudget = 256;
+// Size of the synthetic scene: a grid of rectangles per layer.
+const int mSceneColumns = 32;
+const int mSceneRows = 32;
+const int mSceneLayers = 8;
 
 #endif //~ Glitter Header
@@ -0,0 +1,145 @@
+#ifndef GLITTER_RESIDENCY_H
+#define GLITTER_RESIDENCY_H
+
+// Own headers
+
+// 3rd party headers
+#include <glad/glad.h>
+
+// STL headers
+#include <cstddef>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Tracks every buffer and texture allocation against a VRAM budget.
+//
+// Each resource keeps a copy of its source data in system memory, so that
+// its GPU storage can be released and re-uploaded later. When the resident
+// size exceeds the budget, the least recently used resources are trimmed:
+// textures first lose their top mip levels, buffers and textures without
+// any droppable level are evicted completely. Resources created while
+// over budget start out evicted. Resources touched during the current
+// frame are never trimmed, and are streamed back in on the next update()
+// as long as they fit in the budget. Touched buffers are always streamed
+// back in, even over budget, as drawing from them would read out of
+// bounds otherwise.
+//
+// Usage per frame: beginFrame(), touch*() every visible resource, update(),
+// then issue the draw calls.
+class ResidencyManager
+{
+public:
+  explicit ResidencyManager(std::size_t budgetBytes);
+  ~ResidencyManager();
+
+  // Owns GL objects and iterators into its own list.
+  ResidencyManager(const ResidencyManager&) = delete;
+  ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+  // Create a buffer object and upload its data, if it fits in the budget.
+  GLuint createBuffer(const void* data, std::size_t size, GLenum usage);
+  // Create a mip-mapped 2D texture and upload its base level, if it fits
+  // in the budget.
+  GLuint createTexture2D(GLint internalFormat, GLsizei width, GLsizei height,
+                         GLenum format, GLenum type, const void* data);
+  // Delete the GL object and drop its bookkeeping.
+  void releaseBuffer(GLuint buffer);
+  void releaseTexture(GLuint texture);
+  // Delete all tracked resources.
+  void clear();
+
+  // Account allocations owned elsewhere (e.g. render targets and compute
+  // buffers). They count as resident and are never evicted.
+  void addExternal(std::size_t bytes);
+  void removeExternal(std::size_t bytes);
+  // GPU size of a 2D texture with the given number of mip levels.
+  static std::size_t textureSize(GLint internalFormat, GLsizei width, GLsizei height,
+                                 GLint levels);
+
+  // Mark a resource as used during the current frame.
+  void touchBuffer(GLuint buffer);
+  void touchTexture(GLuint texture);
+
+  void beginFrame();
+  // Trim least recently used resources down to the budget and stream
+  // touched resources back in.
+  void update();
+
+  void setBudget(std::size_t budgetBytes);
+  std::size_t budget() const { return m_BudgetBytes; }
+  // Bytes currently allocated on the GPU.
+  std::size_t residentBytes() const { return m_ResidentBytes; }
+  // Bytes which are tracked but currently not allocated on the GPU.
+  std::size_t evictedBytes() const { return m_TotalBytes - m_ResidentBytes; }
+
+private:
+  enum class Kind { Buffer, Texture };
+  using Key = std::pair<Kind, GLuint>;
+
+  struct Resource
+  {
+    Kind kind;
+    GLuint name;
+    // Copy of the source data, used to restore the GPU storage.
+    std::vector<unsigned char> data;
+    // Size of the fully resident resource in GPU memory.
+    std::size_t fullBytes;
+    std::size_t residentBytes;
+    unsigned long lastUsedFrame;
+
+    // Buffer state.
+    GLenum usage;
+
+    // Texture state. Levels below baseLevel have no storage;
+    // baseLevel > maxLevel means the texture is evicted completely.
+    GLint internalFormat;
+    GLsizei width;
+    GLsizei height;
+    GLenum format;
+    GLenum type;
+    GLint baseLevel;
+    GLint maxLevel;
+  };
+
+  void track(Resource resource);
+  void release(Kind kind, GLuint name);
+  void touch(Kind kind, GLuint name);
+
+  // Release GPU storage of a single resource. Returns false when nothing
+  // could be released.
+  bool trim(Resource& resource);
+  // Re-upload the full GPU storage of a resource.
+  void restore(Resource& resource);
+  // Trim resources, starting with the least recently used one, which
+  // were not touched during the current frame until the resident size
+  // plus extraBytes fits in the budget.
+  bool makeRoom(std::size_t extraBytes);
+
+  void uploadBuffer(Resource& resource);
+  void dropTextureLevel(Resource& resource);
+  void uploadTexture(Resource& resource);
+  std::size_t textureBytes(const Resource& resource, GLint fromLevel) const;
+  // Bind a texture for a batch of operations, saving the caller's
+  // binding and unpack alignment on first use.
+  void bindTexture(GLuint texture);
+  // Restore the state saved by bindTexture(), at the end of a batch.
+  void restoreTextureState();
+
+  std::size_t m_BudgetBytes;
+  std::size_t m_ResidentBytes = 0;
+  std::size_t m_TotalBytes = 0;
+  unsigned long m_Frame = 0;
+
+  bool m_TextureStateSaved = false;
+  GLint m_SavedTexture = 0;
+  GLint m_SavedAlignment = 4;
+  GLuint m_BoundTexture = 0;
+
+  // Resources ordered from most to least recently used.
+  std::list<Resource> m_Resources;
+  std::map<Key, std::list<Resource>::iterator> m_Lookup;
+};
+
+#endif // GLITTER_RESIDENCY_H
@@ -5,9 +5,11 @@
 
 // 3rd party headers
 #include <glad/glad.h>
+#include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 
 // STL headers
+#include <initializer_list>
 #include <string>
 
 class Shader
@@ -15,13 +17,36 @@ class Shader
 public:
   Shader(const std::string &vertexShaderPath,
          const std::string &fragmentShaderPath);
+  explicit Shader(const std::string &computeShaderPath);
+  // Build a program from in-memory sources instead of files.
+  static Shader fromSource(const std::string &vertexShaderSource,
+                           const std::string &fragmentShaderSource);
   void use() const;
+  GLuint id() const { return m_ShaderProgramId; }
   // Utility functions for setting up a uniform variable.
   void setBool(const std::string& name, bool value) const;
   void setInt(const std::string& name, int value) const;
+  void setUint(const std::string& name, unsigned int value) const;
   void setFloat(const std::string& name, float value) const;
   void setVec4f(const std::string& name, const glm::vec4& value);
+  void setVec4fArray(const std::string& name, const glm::vec4* values, int count) const;
+  void setMat4f(const std::string& name, const glm::mat4& value) const;
 private:
+  Shader() = default;
+  // Read a whole shader file, logging failures.
+  static std::string readFile(const std::string &path);
+  // Compile a single stage; the path is only used in error messages.
+  static GLuint compileStage(GLenum type, const std::string &contents,
+                             const std::string &path);
+  // Link the stages into the program and delete them.
+  void linkProgram(std::initializer_list<GLuint> shaders);
+  // Compile both stages and link them; the paths are only used in
+  // error messages.
+  void compileAndLink(const std::string &vertexShaderContents,
+                      const std::string &fragmentShaderContents,
+                      const std::string &vertexShaderPath,
+                      const std::string &fragmentShaderPath);
+
   // The identifier of the shader program.
   GLuint m_ShaderProgramId;
 };
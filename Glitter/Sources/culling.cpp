@@ -0,0 +1,335 @@
+// Own headers
+#include "culling.h"
+
+// 3rd party headers
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// STL headers
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+
+// Work group sizes, which have to match the compute shaders.
+const GLuint cullGroupSize = 64;
+const GLuint depthPyramidGroupSize = 8;
+// Texture unit used by the compute passes, out of the way of the units
+// used for material textures.
+const GLint depthPyramidUnit = 7;
+
+} // namespace
+
+Culler::Culler(const std::vector<ObjectData>& objects, ResidencyManager* residency)
+  : m_Objects(objects)
+  , m_Residency(residency)
+{
+  m_GpuSupported = GLAD_GL_VERSION_4_3;
+
+  // The object buffer is the instanced vertex attribute source on both
+  // paths, and the culling input on the GPU path.
+  glGenBuffers(1, &m_ObjectBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_ObjectBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, m_Objects.size() * sizeof(ObjectData),
+               m_Objects.data(), GL_STATIC_DRAW);
+  m_AccountedBytes = m_Objects.size() * sizeof(ObjectData);
+
+  if (m_GpuSupported)
+  {
+    glGenBuffers(1, &m_CommandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_CommandBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_Objects.size() * sizeof(DrawElementsIndirectCommand),
+                 nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &m_DrawCountBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_DrawCountBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    m_AccountedBytes += m_Objects.size() * sizeof(DrawElementsIndirectCommand) + sizeof(GLuint);
+
+    m_CullShader = std::make_unique<Shader>("cull.comp");
+    m_DepthPyramidShader = std::make_unique<Shader>("depthPyramid.comp");
+
+    // Core since GL 4.6, available through ARB_indirect_parameters on
+    // older contexts (e.g. llvmpipe's GL 4.5).
+    m_IndirectCount = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_indirect_parameters;
+
+    m_Mode = Mode::Gpu;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  if (m_Residency != nullptr)
+  {
+    m_Residency->addExternal(m_AccountedBytes);
+  }
+}
+
+Culler::~Culler()
+{
+  if (m_Residency != nullptr)
+  {
+    m_Residency->removeExternal(m_AccountedBytes);
+  }
+  glDeleteBuffers(1, &m_ObjectBuffer);
+  glDeleteBuffers(1, &m_CommandBuffer);
+  glDeleteBuffers(1, &m_DrawCountBuffer);
+  glDeleteTextures(1, &m_DepthPyramid);
+}
+
+void Culler::attach(GLuint vertexArray, GLuint modelLocation)
+{
+  m_ModelLocation = modelLocation;
+  glBindVertexArray(vertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, m_ObjectBuffer);
+  // A mat4 attribute occupies four consecutive locations, one per column.
+  for (GLuint column = 0; column < 4; ++column)
+  {
+    glVertexAttribPointer(modelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(ObjectData),
+                          (void*)(offsetof(ObjectData, model) + column * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(modelLocation + column);
+    glVertexAttribDivisor(modelLocation + column, 1);
+  }
+  glBindVertexArray(0);
+}
+
+void Culler::setMode(Mode mode)
+{
+  m_Mode = m_GpuSupported ? mode : Mode::Cpu;
+}
+
+void Culler::cull(const glm::mat4& viewProjection)
+{
+  m_ViewProjection = viewProjection;
+  FrustumPlanes planes = extractFrustumPlanes(viewProjection);
+  if (m_Mode == Mode::Gpu)
+  {
+    cullGpu(planes);
+  }
+  else
+  {
+    cullCpu(planes);
+  }
+}
+
+void Culler::draw(GLuint vertexArray) const
+{
+  glBindVertexArray(vertexArray);
+  if (m_Mode == Mode::Gpu)
+  {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+    if (m_IndirectCount)
+    {
+      glBindBuffer(GL_PARAMETER_BUFFER, m_DrawCountBuffer);
+      if (GLAD_GL_VERSION_4_6)
+      {
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0,
+                                         (GLsizei)m_Objects.size(), 0);
+      }
+      else
+      {
+        glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0,
+                                            (GLsizei)m_Objects.size(), 0);
+      }
+      glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+    {
+      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                  (GLsizei)m_Objects.size(), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+  else
+  {
+    // Without base instance support, the model matrix is passed as the
+    // constant value of the disabled model attribute.
+    for (GLuint column = 0; column < 4; ++column)
+    {
+      glDisableVertexAttribArray(m_ModelLocation + column);
+    }
+    for (GLuint index : m_VisibleObjects)
+    {
+      const ObjectData& object = m_Objects[index];
+      for (GLuint column = 0; column < 4; ++column)
+      {
+        glVertexAttrib4fv(m_ModelLocation + column, glm::value_ptr(object.model[column]));
+      }
+      glDrawElementsBaseVertex(GL_TRIANGLES, object.indexCount, GL_UNSIGNED_INT,
+                               (void*)(std::uintptr_t)(object.firstIndex * sizeof(GLuint)),
+                               object.baseVertex);
+    }
+    for (GLuint column = 0; column < 4; ++column)
+    {
+      glEnableVertexAttribArray(m_ModelLocation + column);
+    }
+  }
+  glBindVertexArray(0);
+}
+
+void Culler::buildDepthPyramid(GLuint depthTexture, GLsizei width, GLsizei height)
+{
+  if (!needsDepthPyramid())
+  {
+    return;
+  }
+
+  // (Re-)allocate the pyramid with a full mip chain.
+  if (m_DepthPyramid == 0 || width != m_DepthPyramidWidth || height != m_DepthPyramidHeight)
+  {
+    glDeleteTextures(1, &m_DepthPyramid);
+    std::size_t previousBytes = ResidencyManager::textureSize(GL_R32F, m_DepthPyramidWidth,
+                                                              m_DepthPyramidHeight,
+                                                              m_DepthPyramidLevels);
+    m_DepthPyramidWidth = width;
+    m_DepthPyramidHeight = height;
+    m_DepthPyramidLevels = 1;
+    while ((std::max(width, height) >> m_DepthPyramidLevels) > 0)
+    {
+      ++m_DepthPyramidLevels;
+    }
+
+    glGenTextures(1, &m_DepthPyramid);
+    glActiveTexture(GL_TEXTURE0 + depthPyramidUnit);
+    glBindTexture(GL_TEXTURE_2D, m_DepthPyramid);
+    glTexStorage2D(GL_TEXTURE_2D, m_DepthPyramidLevels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    std::size_t pyramidBytes = ResidencyManager::textureSize(GL_R32F, width, height,
+                                                             m_DepthPyramidLevels);
+    m_AccountedBytes = m_AccountedBytes - previousBytes + pyramidBytes;
+    if (m_Residency != nullptr)
+    {
+      m_Residency->removeExternal(previousBytes);
+      m_Residency->addExternal(pyramidBytes);
+    }
+  }
+
+  m_DepthPyramidShader->use();
+  glActiveTexture(GL_TEXTURE0 + depthPyramidUnit);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  m_DepthPyramidShader->setInt("sourceDepth", depthPyramidUnit);
+
+  // Level 0 is a copy of the depth texture, every further level keeps
+  // the farthest depth of the texels it covers.
+  for (GLint level = 0; level < m_DepthPyramidLevels; ++level)
+  {
+    GLuint levelWidth = std::max(1, width >> level);
+    GLuint levelHeight = std::max(1, height >> level);
+
+    m_DepthPyramidShader->setBool("copyDepth", level == 0);
+    if (level > 0)
+    {
+      glBindImageTexture(0, m_DepthPyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    }
+    glBindImageTexture(1, m_DepthPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((levelWidth + depthPyramidGroupSize - 1) / depthPyramidGroupSize,
+                      (levelHeight + depthPyramidGroupSize - 1) / depthPyramidGroupSize, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+  }
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+
+  // The pyramid is tested against with the camera it was rendered from.
+  m_DepthPyramidViewProjection = m_ViewProjection;
+}
+
+GLuint Culler::visibleCount() const
+{
+  if (m_Mode == Mode::Cpu)
+  {
+    return (GLuint)m_VisibleObjects.size();
+  }
+
+  GLuint count = 0;
+  glBindBuffer(GL_COPY_READ_BUFFER, m_DrawCountBuffer);
+  glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &count);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  return count;
+}
+
+Culler::FrustumPlanes Culler::extractFrustumPlanes(const glm::mat4& viewProjection)
+{
+  // Gribb/Hartmann: the planes are sums and differences of the rows of
+  // the view projection matrix. glm matrices are column major.
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; ++i)
+  {
+    rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                        viewProjection[2][i], viewProjection[3][i]);
+  }
+
+  FrustumPlanes planes = {
+      rows[3] + rows[0], // left
+      rows[3] - rows[0], // right
+      rows[3] + rows[1], // bottom
+      rows[3] - rows[1], // top
+      rows[3] + rows[2], // near
+      rows[3] - rows[2]  // far
+  };
+  for (auto& plane : planes)
+  {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return planes;
+}
+
+bool Culler::sphereInFrustum(const FrustumPlanes& planes, const glm::vec4& sphere)
+{
+  for (const auto& plane : planes)
+  {
+    if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Culler::cullCpu(const FrustumPlanes& planes)
+{
+  m_VisibleObjects.clear();
+  for (GLuint index = 0; index < m_Objects.size(); ++index)
+  {
+    if (sphereInFrustum(planes, m_Objects[index].bounds))
+    {
+      m_VisibleObjects.push_back(index);
+    }
+  }
+}
+
+void Culler::cullGpu(const FrustumPlanes& planes)
+{
+  GLuint zero = 0;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_DrawCountBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_ObjectBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_CommandBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_DrawCountBuffer);
+
+  bool occlusionCulling = m_OcclusionCulling && m_DepthPyramid != 0;
+  m_CullShader->use();
+  m_CullShader->setUint("objectCount", (GLuint)m_Objects.size());
+  m_CullShader->setVec4fArray("frustumPlanes", planes.data(), (int)planes.size());
+  m_CullShader->setBool("compactCommands", m_IndirectCount);
+  m_CullShader->setBool("occlusionCulling", occlusionCulling);
+  if (occlusionCulling)
+  {
+    glActiveTexture(GL_TEXTURE0 + depthPyramidUnit);
+    glBindTexture(GL_TEXTURE_2D, m_DepthPyramid);
+    glActiveTexture(GL_TEXTURE0);
+    m_CullShader->setInt("depthPyramid", depthPyramidUnit);
+    m_CullShader->setMat4f("pyramidViewProjection", m_DepthPyramidViewProjection);
+  }
+
+  glDispatchCompute(((GLuint)m_Objects.size() + cullGroupSize - 1) / cullGroupSize, 1, 1);
+  // Make the commands visible to the indirect draw, and the draw count
+  // to visibleCount().
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT
+                  | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
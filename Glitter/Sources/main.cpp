@@ -1,27 +1,43 @@
 // Own Headers
+#include "culling.h"
 #include "glitter.hpp"
+#include "residency.h"
 #include "shader.h"
 
 // 3rd party headers
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
 #include "stb_image.h"
 
 // STL Headers
+#include <cctype>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 int main(int argc, char * argv[]) {
 
-  // Load GLFW and Create a Window
+  // Load GLFW and Create a Window. GPU culling needs GL 4.3, fall back
+  // to GL 3.3 (e.g. macOS) with CPU culling.
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
   glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
   auto mWindow = glfwCreateWindow(mWidth, mHeight, "OpenGL", nullptr, nullptr);
+  if (mWindow == nullptr) {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    mWindow = glfwCreateWindow(mWidth, mHeight, "OpenGL", nullptr, nullptr);
+  }
 
   // Check for Valid Context
   if (mWindow == nullptr) {
@@ -34,8 +50,38 @@ int main(int argc, char * argv[]) {
   gladLoadGL();
   fprintf(stderr, "OpenGL %s\n", glGetString(GL_VERSION));
 
+  // Account all buffers and textures against the VRAM budget, which can
+  // be overridden in MiB by the first command line argument.
+  std::size_t vramBudget = mVramBudget;
+  if (argc > 1)
+  {
+    std::string argument = argv[1];
+    std::size_t parsed = 0;
+    unsigned long value = 0;
+    try {
+      value = std::stoul(argument, &parsed);
+    } catch (const std::logic_error&)
+    {
+      parsed = 0;
+    }
+    // std::stoul skips whitespace, accepts a sign ("-1" wraps around)
+    // and stops at trailing garbage, so only take plain digits.
+    if (argument.empty() || !std::isdigit((unsigned char)argument[0])
+        || parsed != argument.size()
+        || value > std::numeric_limits<std::size_t>::max() / (1024 * 1024))
+    {
+      std::cerr << "Invalid VRAM budget '" << argv[1] << "', using "
+                << mVramBudget << " MiB." << std::endl;
+    }
+    else
+    {
+      vramBudget = value;
+    }
+  }
+  ResidencyManager residency(vramBudget * 1024 * 1024);
+
   // Build and compile shader programs.
-  Shader rectangleShader("rectangle.vert", "rectangle.frag");
+  Shader sceneShader("scene.vert", "rectangle.frag");
 
   // Set up vertex data and buffers, and configure vertex attributes.
   float verticesRectangle[] = {
@@ -53,22 +99,19 @@ int main(int argc, char * argv[]) {
   // Vertex buffer object and vertex array object.
   unsigned int VBO, VAO;
   glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
+  VBO = residency.createBuffer(verticesRectangle, sizeof(verticesRectangle), GL_STATIC_DRAW);
 
   // We first bind the vertex array object for the left triangle.
   glBindVertexArray(VAO);
 
   // Bind Vertex array buffer.
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(verticesRectangle), verticesRectangle, GL_STATIC_DRAW);
 
   // Create the element buffer object.
-  GLuint EBO;
-  glGenBuffers(1, &EBO);
+  GLuint EBO = residency.createBuffer(rectangleIndices, sizeof(rectangleIndices), GL_STATIC_DRAW);
 
   // Bind it and configure the data layout.
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(rectangleIndices), rectangleIndices, GL_STATIC_DRAW);
 
   // Configure data layout for the rectangle.
   // Vertex positions
@@ -81,41 +124,65 @@ int main(int argc, char * argv[]) {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
   glEnableVertexAttribArray(2);
 
-  // Set up the container texture.
-  GLuint containerTexture;
-  glGenTextures(1, &containerTexture);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, containerTexture);
-  // Configure the texture warping/filtering options on the
-  // currently bound texture object.
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  // Lay out copies of the rectangle in a grid of layers, one behind the
+  // other, so that there is something to cull.
+  std::vector<ObjectData> objects;
+  for (int layer = 0; layer < mSceneLayers; ++layer)
+  for (int row = 0; row < mSceneRows; ++row)
+  for (int column = 0; column < mSceneColumns; ++column)
+  {
+    glm::vec3 position((column - mSceneColumns / 2) * 1.25f,
+                       (row - mSceneRows / 2) * 1.25f,
+                       layer * -2.0f);
+    ObjectData object{};
+    object.model = glm::translate(glm::mat4(1.0f), position);
+    // Bounding sphere of the unit rectangle.
+    object.bounds = glm::vec4(position, 0.7072f);
+    object.indexCount = 6;
+    objects.push_back(object);
+  }
+
+  // Cull on the GPU when compute shaders are available, the model
+  // matrices are fed to the vertex shader from the culler's object buffer.
+  auto culler = std::make_unique<Culler>(objects, &residency);
+  culler->attach(VAO, 3);
+  culler->setOcclusionCulling(true);
+  fprintf(stderr, "Culling on the %s\n", culler->mode() == Culler::Mode::Gpu ? "GPU" : "CPU");
+
+  // Depth of the previous frame, used to build the Hi-Z pyramid.
+  int framebufferWidth, framebufferHeight;
+  glfwGetFramebufferSize(mWindow, &framebufferWidth, &framebufferHeight);
+  GLuint depthTexture;
+  glGenTextures(1, &depthTexture);
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, framebufferWidth, framebufferHeight, 0,
+               GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+  std::size_t depthTextureBytes = ResidencyManager::textureSize(GL_DEPTH_COMPONENT24, framebufferWidth,
+                                                                framebufferHeight, 1);
+  residency.addExternal(depthTextureBytes);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  // Load the texture image.
+  // Load the container texture image.
   int widthContainer, heightContainer, nrChannelsContainer;
   stbi_set_flip_vertically_on_load(true);
   unsigned char *textureDataContainer = stbi_load("container.jpg",
                                          &widthContainer, &heightContainer, &nrChannelsContainer, 0);
+  GLuint containerTexture = 0;
   if (textureDataContainer)
   {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, widthContainer, heightContainer, 0, GL_RGB, GL_UNSIGNED_BYTE, textureDataContainer);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    containerTexture = residency.createTexture2D(GL_RGB, widthContainer, heightContainer,
+                                                 GL_RGB, GL_UNSIGNED_BYTE, textureDataContainer);
   }
   else
   {
     std::cout << "Failed to load texture." << std::endl;
   }
 
-  // Free the texture image memory.
-  stbi_image_free(textureDataContainer);
-
-  // Set up the face texture.
-  GLuint faceTexture;
-  glGenTextures(1, &faceTexture);
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, faceTexture);
+  // Set up the container texture.
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, containerTexture);
   // Configure the texture warping/filtering options on the
   // currently bound texture object.
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -123,46 +190,95 @@ int main(int argc, char * argv[]) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  // Load the texture image.
+  // Free the texture image memory.
+  stbi_image_free(textureDataContainer);
+
+  // Load the face texture image.
   int widthFace, heightFace, nrChannelsFace;
   unsigned char *textureDataFace = stbi_load("awesomeface.png",
                                               &widthFace, &heightFace, &nrChannelsFace, 0);
+  GLuint faceTexture = 0;
   if (textureDataFace)
   {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, widthFace, heightFace, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureDataFace);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    faceTexture = residency.createTexture2D(GL_RGB, widthFace, heightFace,
+                                            GL_RGBA, GL_UNSIGNED_BYTE, textureDataFace);
   }
   else
   {
     std::cout << "Failed to load texture." << std::endl;
   }
 
+  // Set up the face texture.
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, faceTexture);
+  // Configure the texture warping/filtering options on the
+  // currently bound texture object.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
   // Free the texture image memory.
   stbi_image_free(textureDataFace);
 
-  rectangleShader.use();
-  rectangleShader.setInt("containerTexture", 0);
-  rectangleShader.setInt("faceTexture", 1);
+  sceneShader.use();
+  sceneShader.setInt("containerTexture", 0);
+  sceneShader.setInt("faceTexture", 1);
+
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                          (float)framebufferWidth / (float)framebufferHeight,
+                                          0.1f, 100.0f);
+  glEnable(GL_DEPTH_TEST);
 
   // Rendering Loop
   while (glfwWindowShouldClose(mWindow) == false) {
     if (glfwGetKey(mWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
       glfwSetWindowShouldClose(mWindow, true);
+    // Switch between the CPU and the GPU culling path.
+    if (glfwGetKey(mWindow, GLFW_KEY_C) == GLFW_PRESS)
+      culler->setMode(Culler::Mode::Cpu);
+    if (glfwGetKey(mWindow, GLFW_KEY_G) == GLFW_PRESS)
+      culler->setMode(Culler::Mode::Gpu);
 
     // Background Fill Color
     glClearColor(0.25f, 0.25f, 0.25f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Orbit the camera around the grid.
+    float time = (float)glfwGetTime();
+    glm::vec3 cameraPosition(20.0f * std::sin(0.25f * time), 0.0f, 20.0f * std::cos(0.25f * time));
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    culler->cull(viewProjection);
 
-    rectangleShader.use();
+    // Mark everything drawn this frame as visible, so that evicted
+    // buffers and dropped mip levels are streamed back in.
+    residency.beginFrame();
+    residency.touchBuffer(VBO);
+    residency.touchBuffer(EBO);
+    residency.touchTexture(containerTexture);
+    residency.touchTexture(faceTexture);
+    residency.update();
+
+    sceneShader.use();
+    sceneShader.setMat4f("viewProjection", viewProjection);
     // Switch between active textures.
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, containerTexture);
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, faceTexture);
 
-    // Draw rectangle.
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // Draw the rectangles which survived culling.
+    culler->draw(VAO);
+
+    // Keep the depth for occlusion culling in the next frame.
+    if (culler->needsDepthPyramid())
+    {
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_2D, depthTexture);
+      glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, framebufferWidth, framebufferHeight);
+      culler->buildDepthPyramid(depthTexture, framebufferWidth, framebufferHeight);
+    }
 
     // Flip Buffers and Draw
     glfwSwapBuffers(mWindow);
@@ -170,9 +286,13 @@ int main(int argc, char * argv[]) {
   }
 
   // De-allocate all resources once they've outlived their purpose.
+  fprintf(stderr, "VRAM resident %zu bytes, evicted %zu bytes\n",
+          residency.residentBytes(), residency.evictedBytes());
   glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
+  glDeleteTextures(1, &depthTexture);
+  residency.removeExternal(depthTextureBytes);
+  culler.reset();
+  residency.clear();
 
   glfwTerminate();
   return EXIT_SUCCESS;
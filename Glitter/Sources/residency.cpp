@@ -0,0 +1,425 @@
+// Own headers
+#include "residency.h"
+
+// STL headers
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+// Size of a pixel in client memory.
+std::size_t bytesPerPixel(GLenum format, GLenum type)
+{
+  std::size_t components;
+  switch (format)
+  {
+    case GL_RED:  components = 1; break;
+    case GL_RG:   components = 2; break;
+    case GL_RGB:
+    case GL_BGR:  components = 3; break;
+    default:      components = 4; break;
+  }
+
+  std::size_t componentSize;
+  switch (type)
+  {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:           componentSize = 1; break;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:     componentSize = 2; break;
+    default:                componentSize = 4; break;
+  }
+
+  return components * componentSize;
+}
+
+// Size of a texel in GPU memory. Three component formats are assumed
+// to be padded to four components, as most drivers do.
+std::size_t gpuBytesPerTexel(GLint internalFormat)
+{
+  switch (internalFormat)
+  {
+    case GL_RED:
+    case GL_R8:             return 1;
+    case GL_RG:
+    case GL_RG8:
+    case GL_R16F:           return 2;
+    case GL_RG16F:
+    case GL_R32F:           return 4;
+    case GL_RGB16F:
+    case GL_RGBA16F:
+    case GL_RG32F:          return 8;
+    case GL_RGB32F:
+    case GL_RGBA32F:        return 16;
+    default:                return 4;
+  }
+}
+
+std::size_t levelBytes(GLsizei width, GLsizei height, GLint level, std::size_t pixelSize)
+{
+  std::size_t levelWidth = std::max(1, width >> level);
+  std::size_t levelHeight = std::max(1, height >> level);
+  return levelWidth * levelHeight * pixelSize;
+}
+
+} // namespace
+
+ResidencyManager::ResidencyManager(std::size_t budgetBytes)
+  : m_BudgetBytes(budgetBytes)
+{
+}
+
+ResidencyManager::~ResidencyManager()
+{
+  clear();
+}
+
+GLuint ResidencyManager::createBuffer(const void* data, std::size_t size, GLenum usage)
+{
+  Resource resource{};
+  resource.kind = Kind::Buffer;
+  resource.usage = usage;
+  resource.fullBytes = size;
+  resource.data.resize(size);
+  if (data != nullptr)
+  {
+    std::memcpy(resource.data.data(), data, size);
+  }
+
+  glGenBuffers(1, &resource.name);
+  if (makeRoom(resource.fullBytes))
+  {
+    uploadBuffer(resource);
+  }
+  else
+  {
+    // Over budget, create the buffer evicted. It is uploaded on the
+    // first update() after it is touched.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resource.name);
+    glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, resource.usage);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    resource.residentBytes = 0;
+  }
+
+  GLuint name = resource.name;
+  track(std::move(resource));
+  return name;
+}
+
+GLuint ResidencyManager::createTexture2D(GLint internalFormat, GLsizei width, GLsizei height,
+                                         GLenum format, GLenum type, const void* data)
+{
+  Resource resource{};
+  resource.kind = Kind::Texture;
+  resource.internalFormat = internalFormat;
+  resource.width = width;
+  resource.height = height;
+  resource.format = format;
+  resource.type = type;
+  resource.maxLevel = 0;
+  while ((std::max(width, height) >> (resource.maxLevel + 1)) > 0)
+  {
+    ++resource.maxLevel;
+  }
+  resource.fullBytes = textureBytes(resource, 0);
+
+  // Only the base level is kept in system memory, the rest of the mip
+  // chain is regenerated on the GPU when the texture is restored.
+  std::size_t baseBytes = levelBytes(width, height, 0, bytesPerPixel(format, type));
+  resource.data.resize(baseBytes);
+  if (data != nullptr)
+  {
+    std::memcpy(resource.data.data(), data, baseBytes);
+  }
+
+  glGenTextures(1, &resource.name);
+  if (makeRoom(resource.fullBytes))
+  {
+    uploadTexture(resource);
+  }
+  else
+  {
+    // Over budget, create the texture without storage. It is uploaded
+    // on the first update() after it is touched.
+    bindTexture(resource.name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, resource.maxLevel);
+    resource.baseLevel = resource.maxLevel + 1;
+    resource.residentBytes = 0;
+  }
+  restoreTextureState();
+
+  GLuint name = resource.name;
+  track(std::move(resource));
+  return name;
+}
+
+void ResidencyManager::releaseBuffer(GLuint buffer)
+{
+  release(Kind::Buffer, buffer);
+}
+
+void ResidencyManager::releaseTexture(GLuint texture)
+{
+  release(Kind::Texture, texture);
+}
+
+void ResidencyManager::clear()
+{
+  while (!m_Resources.empty())
+  {
+    release(m_Resources.back().kind, m_Resources.back().name);
+  }
+}
+
+void ResidencyManager::addExternal(std::size_t bytes)
+{
+  m_TotalBytes += bytes;
+  m_ResidentBytes += bytes;
+}
+
+void ResidencyManager::removeExternal(std::size_t bytes)
+{
+  m_TotalBytes -= bytes;
+  m_ResidentBytes -= bytes;
+}
+
+std::size_t ResidencyManager::textureSize(GLint internalFormat, GLsizei width, GLsizei height,
+                                          GLint levels)
+{
+  std::size_t bytes = 0;
+  for (GLint level = 0; level < levels; ++level)
+  {
+    bytes += levelBytes(width, height, level, gpuBytesPerTexel(internalFormat));
+  }
+  return bytes;
+}
+
+void ResidencyManager::touchBuffer(GLuint buffer)
+{
+  touch(Kind::Buffer, buffer);
+}
+
+void ResidencyManager::touchTexture(GLuint texture)
+{
+  touch(Kind::Texture, texture);
+}
+
+void ResidencyManager::beginFrame()
+{
+  ++m_Frame;
+}
+
+void ResidencyManager::update()
+{
+  makeRoom(0);
+
+  // Touched resources sit at the front of the list.
+  for (auto& resource : m_Resources)
+  {
+    if (resource.lastUsedFrame != m_Frame)
+    {
+      break;
+    }
+    if (resource.residentBytes == resource.fullBytes)
+    {
+      continue;
+    }
+    if (makeRoom(resource.fullBytes - resource.residentBytes))
+    {
+      restore(resource);
+    }
+    else if (resource.kind == Kind::Buffer)
+    {
+      // Drawing from a buffer without storage reads out of bounds, so
+      // touched buffers are restored even over budget. Textures only
+      // lose detail and stay trimmed.
+      fprintf(stderr, "Buffer %u restored over the VRAM budget\n", resource.name);
+      restore(resource);
+    }
+  }
+  restoreTextureState();
+}
+
+void ResidencyManager::setBudget(std::size_t budgetBytes)
+{
+  m_BudgetBytes = budgetBytes;
+}
+
+void ResidencyManager::track(Resource resource)
+{
+  resource.lastUsedFrame = m_Frame;
+  m_TotalBytes += resource.fullBytes;
+  m_ResidentBytes += resource.residentBytes;
+
+  Key key(resource.kind, resource.name);
+  m_Resources.push_front(std::move(resource));
+  m_Lookup[key] = m_Resources.begin();
+}
+
+void ResidencyManager::release(Kind kind, GLuint name)
+{
+  auto it = m_Lookup.find(Key(kind, name));
+  if (it == m_Lookup.end())
+  {
+    return;
+  }
+
+  Resource& resource = *it->second;
+  if (kind == Kind::Buffer)
+  {
+    glDeleteBuffers(1, &resource.name);
+  }
+  else
+  {
+    glDeleteTextures(1, &resource.name);
+  }
+  m_TotalBytes -= resource.fullBytes;
+  m_ResidentBytes -= resource.residentBytes;
+
+  m_Resources.erase(it->second);
+  m_Lookup.erase(it);
+}
+
+void ResidencyManager::touch(Kind kind, GLuint name)
+{
+  auto it = m_Lookup.find(Key(kind, name));
+  if (it == m_Lookup.end())
+  {
+    return;
+  }
+
+  it->second->lastUsedFrame = m_Frame;
+  m_Resources.splice(m_Resources.begin(), m_Resources, it->second);
+}
+
+bool ResidencyManager::trim(Resource& resource)
+{
+  if (resource.residentBytes == 0)
+  {
+    return false;
+  }
+
+  m_ResidentBytes -= resource.residentBytes;
+  if (resource.kind == Kind::Buffer)
+  {
+    // Orphan the storage but keep the name, so that vertex array
+    // objects referencing the buffer stay valid.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resource.name);
+    glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, resource.usage);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    resource.residentBytes = 0;
+  }
+  else
+  {
+    dropTextureLevel(resource);
+  }
+  m_ResidentBytes += resource.residentBytes;
+  return true;
+}
+
+void ResidencyManager::restore(Resource& resource)
+{
+  m_ResidentBytes -= resource.residentBytes;
+  if (resource.kind == Kind::Buffer)
+  {
+    uploadBuffer(resource);
+  }
+  else
+  {
+    uploadTexture(resource);
+  }
+  m_ResidentBytes += resource.residentBytes;
+}
+
+bool ResidencyManager::makeRoom(std::size_t extraBytes)
+{
+  // Walk once from the least recently used resource, trimming each one
+  // as far as needed before moving on. Touched resources sit at the
+  // front, so reaching one means nothing else can be trimmed.
+  for (auto it = m_Resources.rbegin(); it != m_Resources.rend(); ++it)
+  {
+    if (m_ResidentBytes + extraBytes <= m_BudgetBytes || it->lastUsedFrame == m_Frame)
+    {
+      break;
+    }
+    while (m_ResidentBytes + extraBytes > m_BudgetBytes && trim(*it))
+    {
+    }
+  }
+  return m_ResidentBytes + extraBytes <= m_BudgetBytes;
+}
+
+void ResidencyManager::uploadBuffer(Resource& resource)
+{
+  glBindBuffer(GL_COPY_WRITE_BUFFER, resource.name);
+  glBufferData(GL_COPY_WRITE_BUFFER, resource.data.size(), resource.data.data(), resource.usage);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  resource.residentBytes = resource.fullBytes;
+}
+
+void ResidencyManager::bindTexture(GLuint texture)
+{
+  // Query the caller's state once per batch of texture operations.
+  if (!m_TextureStateSaved)
+  {
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &m_SavedTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &m_SavedAlignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    m_TextureStateSaved = true;
+    m_BoundTexture = (GLuint)m_SavedTexture;
+  }
+  if (m_BoundTexture != texture)
+  {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_BoundTexture = texture;
+  }
+}
+
+void ResidencyManager::restoreTextureState()
+{
+  if (m_TextureStateSaved)
+  {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, m_SavedAlignment);
+    glBindTexture(GL_TEXTURE_2D, (GLuint)m_SavedTexture);
+    m_TextureStateSaved = false;
+  }
+}
+
+void ResidencyManager::dropTextureLevel(Resource& resource)
+{
+  bindTexture(resource.name);
+
+  // Move the base level past the dropped level first, so that the
+  // texture stays complete, then release the level's storage.
+  GLint droppedLevel = resource.baseLevel++;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, std::min(resource.baseLevel, resource.maxLevel));
+  glTexImage2D(GL_TEXTURE_2D, droppedLevel, resource.internalFormat, 0, 0, 0,
+               resource.format, resource.type, nullptr);
+  resource.residentBytes = textureBytes(resource, resource.baseLevel);
+}
+
+void ResidencyManager::uploadTexture(Resource& resource)
+{
+  bindTexture(resource.name);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, resource.maxLevel);
+  glTexImage2D(GL_TEXTURE_2D, 0, resource.internalFormat, resource.width, resource.height, 0,
+               resource.format, resource.type, resource.data.data());
+  glGenerateMipmap(GL_TEXTURE_2D);
+  resource.baseLevel = 0;
+  resource.residentBytes = resource.fullBytes;
+}
+
+std::size_t ResidencyManager::textureBytes(const Resource& resource, GLint fromLevel) const
+{
+  std::size_t pixelSize = gpuBytesPerTexel(resource.internalFormat);
+  std::size_t bytes = 0;
+  for (GLint level = fromLevel; level <= resource.maxLevel; ++level)
+  {
+    bytes += levelBytes(resource.width, resource.height, level, pixelSize);
+  }
+  return bytes;
+}
@@ -1,6 +1,9 @@
 // Own headers
 #include "shader.h"
 
+// 3rd party headers
+#include <glm/gtc/type_ptr.hpp>
+
 // STL headers
 #include <iostream>
 #include <fstream>
@@ -11,83 +14,106 @@
 Shader::Shader(const std::string &vertexShaderPath,
                const std::string &fragmentShaderPath)
 {
-  std::ifstream vertexShaderFile;
-  std::ifstream fragmentShaderFile;
-  std::string vertexShaderContents;
-  std::string fragmentShaderContents;
+  compileAndLink(readFile(vertexShaderPath), readFile(fragmentShaderPath),
+                 vertexShaderPath, fragmentShaderPath);
+}
+
+Shader::Shader(const std::string &computeShaderPath)
+{
+  GLuint computeShader = compileStage(GL_COMPUTE_SHADER, readFile(computeShaderPath),
+                                      computeShaderPath);
+  linkProgram({computeShader});
+}
+
+Shader Shader::fromSource(const std::string &vertexShaderSource,
+                          const std::string &fragmentShaderSource)
+{
+  Shader shader;
+  shader.compileAndLink(vertexShaderSource, fragmentShaderSource,
+                        "<vertex source>", "<fragment source>");
+  return shader;
+}
+
+std::string Shader::readFile(const std::string &path)
+{
+  std::ifstream file;
 
-  // Make sure the shaders can throw exceptions.
-  vertexShaderFile.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-  fragmentShaderFile.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+  // Make sure the shader can throw exceptions.
+  file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
 
-  // Read in the shaders.
+  // Read the whole file into a string.
   try {
-    // Open files.
-    vertexShaderFile.open(vertexShaderPath);
-    fragmentShaderFile.open(fragmentShaderPath);
-
-    // Read file's contents into streams.
-    std::stringstream vertexShaderFileStream, fragmentShaderFileStream;
-    vertexShaderFileStream << vertexShaderFile.rdbuf();
-    fragmentShaderFileStream << fragmentShaderFile.rdbuf();
-
-    // Read the whole files into the buffers.
-    vertexShaderContents = vertexShaderFileStream.str();
-    fragmentShaderContents = fragmentShaderFileStream.str();
+    file.open(path);
+    std::stringstream fileStream;
+    fileStream << file.rdbuf();
+    return fileStream.str();
   } catch (const std::ifstream::failure& exception)
   {
-    std::cerr << "An error occurred while reading in the shader files: " << std::endl;
-    std::cerr << "- " << vertexShaderPath << std::endl;
-    std::cerr << "- " << fragmentShaderPath << std::endl;
+    std::cerr << "An error occurred while reading in the shader file: " << std::endl;
+    std::cerr << "- " << path << std::endl;
   }
+  return std::string();
+}
 
-  // Bookkeeping for shader compilation.
-  GLint success;
-  GLchar errorLogBuffer[512];
-
-  // Create and compile the vertex shader.
+GLuint Shader::compileStage(GLenum type, const std::string &contents, const std::string &path)
+{
   // Note: One needs the const char* of the string to be able to pass it.
   //       See: https://stackoverflow.com/a/38260633/2935386
-  const GLchar* vertexShaderContentsCStyle = vertexShaderContents.c_str();
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderContentsCStyle, nullptr);
-  glCompileShader(vertexShader);
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-  if (!success)
-  {
-    glGetProgramInfoLog(vertexShader, 512, nullptr, errorLogBuffer);
-    std::cerr << "An error occurred while compiling vertex shader '"
-              << vertexShaderPath << "'." << std::endl;
-  }
+  const GLchar* contentsCStyle = contents.c_str();
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &contentsCStyle, nullptr);
+  glCompileShader(shader);
 
-  // Create and compile fragment shader.
-  const GLchar* fragmentShaderContentsCStyle = fragmentShaderContents.c_str();
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragmentShader, 1, &fragmentShaderContentsCStyle, nullptr);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+  GLint success;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
   if (!success)
   {
-    glGetProgramInfoLog(fragmentShader, 512, nullptr, errorLogBuffer);
-    std::cerr << "An error occurred while compiling fragment shader '"
-              << fragmentShaderPath << "'." << std::endl;
+    GLchar errorLogBuffer[512];
+    glGetShaderInfoLog(shader, 512, nullptr, errorLogBuffer);
+    const char* stage = type == GL_VERTEX_SHADER ? "vertex"
+                      : type == GL_FRAGMENT_SHADER ? "fragment" : "compute";
+    std::cerr << "An error occurred while compiling " << stage << " shader '"
+              << path << "':" << std::endl << errorLogBuffer << std::endl;
   }
+  return shader;
+}
 
+void Shader::linkProgram(std::initializer_list<GLuint> shaders)
+{
   // Create and link the shader program.
   m_ShaderProgramId = glCreateProgram();
-  glAttachShader(m_ShaderProgramId, vertexShader);
-  glAttachShader(m_ShaderProgramId, fragmentShader);
+  for (GLuint shader : shaders)
+  {
+    glAttachShader(m_ShaderProgramId, shader);
+  }
   glLinkProgram(m_ShaderProgramId);
+
+  GLint success;
   glGetProgramiv(m_ShaderProgramId, GL_LINK_STATUS, &success);
   if (!success)
   {
+    GLchar errorLogBuffer[512];
     glGetProgramInfoLog(m_ShaderProgramId, 512, nullptr, errorLogBuffer);
-    std::cerr << "An error occurred while linking the shader program." << std::endl;
+    std::cerr << "An error occurred while linking the shader program:" << std::endl
+              << errorLogBuffer << std::endl;
   }
 
   // Delete the shaders.
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  for (GLuint shader : shaders)
+  {
+    glDeleteShader(shader);
+  }
+}
+
+void Shader::compileAndLink(const std::string &vertexShaderContents,
+                            const std::string &fragmentShaderContents,
+                            const std::string &vertexShaderPath,
+                            const std::string &fragmentShaderPath)
+{
+  GLuint vertexShader = compileStage(GL_VERTEX_SHADER, vertexShaderContents, vertexShaderPath);
+  GLuint fragmentShader = compileStage(GL_FRAGMENT_SHADER, fragmentShaderContents,
+                                       fragmentShaderPath);
+  linkProgram({vertexShader, fragmentShader});
 }
 
 void Shader::use() const
@@ -105,6 +131,11 @@ void Shader::setInt(const std::string& name, int value) const
   glUniform1i(glGetUniformLocation(m_ShaderProgramId, name.c_str()), (GLint)value);
 }
 
+void Shader::setUint(const std::string& name, unsigned int value) const
+{
+  glUniform1ui(glGetUniformLocation(m_ShaderProgramId, name.c_str()), (GLuint)value);
+}
+
 void Shader::setFloat(const std::string& name, float value) const
 {
   glUniform1f(glGetUniformLocation(m_ShaderProgramId, name.c_str()), (GLfloat)value);
@@ -114,3 +145,13 @@ void Shader::setVec4f(const std::string &name, const glm::vec4 &value)
 {
   glUniform4f(glGetUniformLocation(m_ShaderProgramId, name.c_str()), value.x, value.y, value.z, value.w);
 }
+
+void Shader::setVec4fArray(const std::string& name, const glm::vec4* values, int count) const
+{
+  glUniform4fv(glGetUniformLocation(m_ShaderProgramId, name.c_str()), count, glm::value_ptr(values[0]));
+}
+
+void Shader::setMat4f(const std::string& name, const glm::mat4& value) const
+{
+  glUniformMatrix4fv(glGetUniformLocation(m_ShaderProgramId, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+}